@@ -0,0 +1,71 @@
+/**
+ * bench.h - throughput measurement for the kernel benchmarks
+ *
+ * Numbers are for the host CPU; use them to compare kernel versions, not to predict ESP8266 timings.
+ */
+
+#ifndef SMTPC_BENCH_H_
+#define SMTPC_BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SMTPC_BENCH_CYCLES() __rdtsc()
+#endif
+
+/**
+ * runs fn until at least minBytes were processed and prints MB/s and cycles/byte
+ * @param name const char *  input set
+ * @param bytes size_t       bytes processed by one call of fn
+ * @param fn                 kernel under test
+ */
+template<typename Fn>
+static void bench(const char * name, size_t bytes, Fn fn, size_t minBytes = 64 * 1024 * 1024) {
+    using namespace std::chrono;
+    size_t iterations = minBytes / (bytes ? bytes : 1) + 1;
+
+    fn(); /* warm up */
+#ifdef SMTPC_BENCH_CYCLES
+    uint64_t c0 = SMTPC_BENCH_CYCLES();
+#endif
+    steady_clock::time_point t0 = steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    double seconds = duration_cast<duration<double> >(steady_clock::now() - t0).count();
+    double total = (double) bytes * iterations;
+#ifdef SMTPC_BENCH_CYCLES
+    double cycles = (double) (SMTPC_BENCH_CYCLES() - c0) / total;
+    printf("%-40s %10.1f MB/s %8.2f cycles/byte\n", name, total / seconds / 1e6, cycles);
+#else
+    printf("%-40s %10.1f MB/s %8s cycles/byte\n", name, total / seconds / 1e6, "n/a");
+#endif
+}
+
+/**
+ * realistic text body: lines of ~70 characters with CRLF, occasional line starting with '.'
+ */
+static inline std::string benchTextBody(size_t size) {
+    static const char * line = "The quick brown fox jumps over the lazy dog, sensor reading 23.5 C";
+    std::string out;
+    for (unsigned n = 0; out.size() < size; n++) {
+        if (n % 50 == 0) { out += "."; }
+        out += line;
+        out += "\r\n";
+    }
+    out.resize(size);
+    return out;
+}
+
+static inline std::string benchRepeat(const char * pattern, size_t size) {
+    std::string out;
+    while (out.size() < size) { out += pattern; }
+    out.resize(size);
+    return out;
+}
+
+#endif /* SMTPC_BENCH_H_ */
@@ -0,0 +1,27 @@
+/**
+ * bench_dotstuff.cpp - sendPayload() dot-stuffing throughput
+ */
+
+#include "smtpc_test.h"
+#include "bench.h"
+
+int main() {
+    TestClient smtp;
+    const size_t size = 64 * 1024;
+    struct { const char * name; std::string body; } inputs[] = {
+        { "text body, CRLF lines", benchTextBody(size) },
+        { "no line breaks", benchRepeat("x", size) },
+        { "only LF (adversarial)", benchRepeat("\n", size) },
+        { "every line a dot (adversarial)", benchRepeat("\n.", size) },
+    };
+
+    printf("dot-stuffing, %u byte bodies\n", (unsigned) size);
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        const std::string & body = inputs[i].body;
+        bench(inputs[i].name, body.size(), [&]() {
+            smtp.attach();
+            smtp.sendPayload(body.data(), body.size());
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+/**
+ * bench_recipients.cpp - addRecipients() address splitting throughput
+ */
+
+#include "smtpc_test.h"
+#include "bench.h"
+
+int main() {
+    TestClient smtp;
+    std::string list;
+    for (int i = 0; i < 20; i++) {
+        list += "\"Doe, John\" <john.doe@example.com>, ";
+    }
+    struct { const char * name; std::string to; } inputs[] = {
+        { "single address", "recipient@otherdomain.example" },
+        { "20 named addresses", list },
+        { "commas only (adversarial)", benchRepeat(",", 4096) },
+        { "escaped quoted string (adversarial)", "\"" + benchRepeat("\\\"", 4094) + "\"" },
+    };
+
+    printf("address splitting\n");
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        const std::string & to = inputs[i].to;
+        bench(inputs[i].name, to.size(), [&]() {
+            smtp.clearRecipients();
+            smtp.addRecipients(to.c_str());
+        }, 16 * 1024 * 1024);
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+/**
+ * bench_response.cpp - handleResponse() reply line handling throughput
+ */
+
+#include "smtpc_test.h"
+#include "bench.h"
+
+int main() {
+    TestClient smtp;
+    std::string ehlo = "250-mail.example.com Hello\r\n";
+    for (int i = 0; i < 100; i++) {
+        ehlo += "250-EXTENSION-WITH-A-LONG-NAME PARAM\r\n";
+    }
+    ehlo += "250 OK\r\n";
+    struct { const char * name; std::string reply; } inputs[] = {
+        { "single line reply", "250 2.0.0 Ok: queued as 12345\r\n" },
+        { "102 line reply (adversarial)", ehlo },
+        { "4 KiB line (adversarial)", "250 " + benchRepeat("x", 4096) + "\r\n" },
+    };
+
+    printf("reply parsing\n");
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        const std::string & reply = inputs[i].reply;
+        bench(inputs[i].name, reply.size(), [&]() {
+            smtp.attach(reply);
+            smtp.handleResponse();
+        }, 16 * 1024 * 1024);
+    }
+    return 0;
+}
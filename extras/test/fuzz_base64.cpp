@@ -0,0 +1,36 @@
+/**
+ * fuzz_base64.cpp - encodeSubject() words decoded by the reference base64 decoding
+ */
+
+#include "smtpc_test.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size) {
+    std::string subject((const char *) data, size);
+    subject.resize(strlen(subject.c_str())); /* The subject ends at the first NUL */
+    String out;
+    if (!TestClient::encodeSubject(out, subject.c_str())) {
+        abort();
+    }
+
+    bool ok;
+    std::vector<std::string> words;
+    if (refDecodeSubject(out.c_str(), ok, &words) != subject || !ok) {
+        abort();
+    }
+    /* A word starts on a whole UTF-8 character unless the word before it is a run of continuation bytes */
+    for (size_t i = 1; i < words.size(); i++) {
+        const std::string & prev = words[i - 1];
+        if ((words[i][0] & 0xC0) != 0x80) {
+            continue;
+        }
+        if (prev.size() != (i == 1 ? SMTPCLIENT_SUBJECT_FIRST_BYTES : SMTPCLIENT_SUBJECT_WORD_BYTES)) {
+            abort();
+        }
+        for (size_t j = 1; j < prev.size(); j++) {
+            if ((prev[j] & 0xC0) != 0x80) {
+                abort();
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+/**
+ * fuzz_dotstuff.cpp - sendPayload() output stream against the reference dot-stuffing
+ */
+
+#include "smtpc_test.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    static TestClient smtp;
+    std::string out;
+    WiFiClient::sink = &out;
+    smtp.attach();
+    if (!smtp.sendPayload((const char *) data, size)) {
+        abort();
+    }
+    WiFiClient::sink = NULL;
+    if (out != refDotStuff(std::string((const char *) data, size))) {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * fuzz_main.cpp - standalone driver for the fuzz targets when libFuzzer is not available
+ *
+ * Usage: fuzz_<kernel> [iterations] [seed]
+ * Inputs are random, biased towards the bytes and sequences the kernels branch on.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size);
+
+int main(int argc, char ** argv) {
+    /* Bytes and sequences the kernels branch on: line ends, dot-stuffing, address syntax,
+     * reply codes and continuation marks, UTF-8 characters of 2 to 4 bytes and a stray continuation byte */
+    static const char * special[] = {
+        "\r", "\n", "\r\n", ".", ",", "<", ">", "\"", "\\", " ", "a", "@",
+        "250", "250-", "250 ", "354 ", "-", "\xC3\xA4", "\xE2\x82\xAC", "\xF0\x9F\x93\xA7", "\x80"
+    };
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+    srand(seed);
+
+    std::vector<uint8_t> buf;
+    for (unsigned long i = 0; i < iterations; i++) {
+        size_t pieces = rand() % 257;
+        buf.clear();
+        for (size_t j = 0; j < pieces; j++) {
+            if (rand() % 4) {
+                const char * seq = special[rand() % (sizeof(special) / sizeof(special[0]))];
+                buf.insert(buf.end(), seq, seq + strlen(seq));
+            } else {
+                buf.push_back((uint8_t) rand());
+            }
+        }
+        LLVMFuzzerTestOneInput(buf.data(), buf.size());
+    }
+    printf("%lu inputs, seed %lu: ok\n", iterations, seed);
+    return 0;
+}
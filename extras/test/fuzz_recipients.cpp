@@ -0,0 +1,17 @@
+/**
+ * fuzz_recipients.cpp - addRecipients() split against the reference splitting
+ */
+
+#include "smtpc_test.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size) {
+    std::string to((const char *) data, size);
+    TestClient smtp;
+    if (!smtp.addRecipients(to.c_str())) {
+        abort();
+    }
+    if (refSplitRecipients(to.c_str()) != smtp.recipients().c_str()) {
+        abort();
+    }
+    return 0;
+}
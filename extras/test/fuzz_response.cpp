@@ -0,0 +1,27 @@
+/**
+ * fuzz_response.cpp - handleResponse() on scripted server replies against the reference reply parsing
+ */
+
+#include <string.h>
+
+#include "smtpc_test.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size) {
+    if (size == 0) { /* No reply at all waits for the timeout */
+        return 0;
+    }
+    std::string rx((const char *) data, size), msg;
+    TestClient smtp;
+    smtp.attach(rx);
+    int code = refParseReply(rx, msg);
+    if (smtp.handleResponse() != code) {
+        abort();
+    }
+    if (code > 0 && strcmp(msg.c_str(), smtp.getErrorMessage()) != 0) { /* The message ends at the first NUL */
+        abort();
+    }
+    if (strlen(smtp.getErrorMessage()) > SMTPCLIENT_MAX_REPLY_LENGTH) {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * Arduino.h - host shim for the ESP8266SMTPClient tests and benchmarks
+ *
+ * Only the parts of the Arduino core used by the library are provided.
+ */
+
+#ifndef SMTPC_SHIM_ARDUINO_H_
+#define SMTPC_SHIM_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+typedef bool boolean;
+
+unsigned long millis(void);
+void delay(unsigned long ms);
+void yield(void);
+
+class String {
+    public:
+        String() {}
+        String(const char * cstr) : _s(cstr ? cstr : "") {}
+        String(const String & str) : _s(str._s) {}
+        explicit String(char c) : _s(1, c) {}
+        String & operator=(const String & rhs) { _s = rhs._s; return *this; }
+        String & operator=(const char * cstr) { _s = cstr ? cstr : ""; return *this; }
+
+        unsigned char reserve(unsigned int size) {
+            if (size > _reserveLimit) { return 0; }
+            _s.reserve(size);
+            return 1;
+        }
+        unsigned int length(void) const { return _s.length(); }
+        const char * c_str() const { return _s.c_str(); }
+
+        unsigned char concat(const String & str) { return concat(str._s.data(), str._s.length()); }
+        unsigned char concat(const char * cstr) { return cstr ? concat(cstr, strlen(cstr)) : 0; }
+        unsigned char concat(const char * cstr, unsigned int len) {
+            if (_s.length() + len > _reserveLimit) { return 0; }
+            _s.append(cstr, len);
+            return 1;
+        }
+        unsigned char concat(char c) { return concat(&c, 1); }
+        String & operator+=(const String & rhs) { concat(rhs); return *this; }
+        String & operator+=(const char * cstr) { concat(cstr); return *this; }
+        String & operator+=(char c) { concat(c); return *this; }
+
+        char operator[](unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+        char & operator[](unsigned int index) {
+            static char dummy;
+            if (index >= _s.length()) { dummy = 0; return dummy; } /* Like the core, no out of range write */
+            return _s[index];
+        }
+        void remove(unsigned int index) { if (index < _s.length()) { _s.resize(index); } }
+        bool operator==(const String & rhs) const { return _s == rhs._s; }
+        bool operator==(const char * cstr) const { return _s == cstr; }
+
+        int indexOf(char ch, unsigned int fromIndex = 0) const {
+            size_t pos = _s.find(ch, fromIndex);
+            return pos == std::string::npos ? -1 : (int) pos;
+        }
+        String substring(unsigned int beginIndex) const { return substring(beginIndex, _s.length()); }
+        String substring(unsigned int left, unsigned int right) const {
+            if (left > right) { unsigned int t = left; left = right; right = t; }
+            if (left >= _s.length()) { return String(); }
+            if (right > _s.length()) { right = _s.length(); }
+            String out;
+            out._s = _s.substr(left, right - left);
+            return out;
+        }
+        void replace(const char * find, const char * replace) {
+            size_t flen = strlen(find), rlen = strlen(replace), pos = 0;
+            while (flen && (pos = _s.find(find, pos)) != std::string::npos) {
+                _s.replace(pos, flen, replace);
+                pos += rlen;
+            }
+        }
+        void trim(void) {
+            size_t b = 0, e = _s.length();
+            while (b < e && isspace((unsigned char) _s[b])) { b++; }
+            while (e > b && isspace((unsigned char) _s[e - 1])) { e--; }
+            _s = _s.substr(b, e - b);
+        }
+        long toInt(void) const { return atol(_s.c_str()); }
+
+        /* Test hook: allocations past this size fail like on a starved heap */
+        static size_t _reserveLimit;
+
+    private:
+        std::string _s;
+};
+
+String operator+(const String & lhs, const String & rhs);
+String operator+(const String & lhs, const char * rhs);
+String operator+(const char * lhs, const String & rhs);
+String operator+(const String & lhs, char rhs);
+String operator+(char lhs, const String & rhs);
+
+class EspClass {
+    public:
+        uint32_t getFreeHeap(void) { return freeHeap; }
+        uint32_t getMaxFreeBlockSize(void) { return maxFreeBlock; }
+
+        /* Test hooks */
+        uint32_t freeHeap = 40000;
+        uint32_t maxFreeBlock = 30000;
+};
+
+extern EspClass ESP;
+
+#endif /* SMTPC_SHIM_ARDUINO_H_ */
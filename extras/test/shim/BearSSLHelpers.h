@@ -0,0 +1,25 @@
+/**
+ * BearSSLHelpers.h - host shim, any non-empty key is accepted as a 2048 bit RSA key
+ */
+
+#ifndef SMTPC_SHIM_BEARSSLHELPERS_H_
+#define SMTPC_SHIM_BEARSSLHELPERS_H_
+
+#include <string.h>
+#include <bearssl/bearssl.h>
+
+namespace BearSSL {
+
+class PrivateKey {
+    public:
+        PrivateKey(const char * pemKey) { _key.n_bitlen = (pemKey && pemKey[0]) ? 2048 : 0; }
+        bool isRSA() const { return _key.n_bitlen != 0; }
+        const br_rsa_private_key * getRSA() const { return &_key; }
+
+    private:
+        br_rsa_private_key _key;
+};
+
+};
+
+#endif /* SMTPC_SHIM_BEARSSLHELPERS_H_ */
@@ -0,0 +1,51 @@
+/**
+ * ESP8266WiFi.h - host shim, WiFiClient talking to a scripted SMTP server
+ */
+
+#ifndef SMTPC_SHIM_ESP8266WIFI_H_
+#define SMTPC_SHIM_ESP8266WIFI_H_
+
+#include <Arduino.h>
+
+class WiFiClient {
+    public:
+        WiFiClient() : _rx(script), _rxPos(0), _open(false) {}
+        virtual ~WiFiClient() {}
+
+        int connect(const char * host, uint16_t port) { (void) host; (void) port; _open = true; return 1; }
+        uint8_t connected() { return _open; }
+        int available() { return _open ? (int) (_rx.length() - _rxPos) : 0; }
+        int read() { return available() ? (unsigned char) _rx[_rxPos++] : -1; }
+        String readStringUntil(char terminator) {
+            String out;
+            while (available()) {
+                char c = _rx[_rxPos++];
+                if (c == terminator) { break; }
+                out += c;
+            }
+            return out;
+        }
+        size_t write(const uint8_t * buf, size_t size) { return write((const char *) buf, size); }
+        size_t write(const char * buf, size_t size) {
+            if (!_open) { return 0; }
+            if (sink) { sink->append(buf, size); }
+            return size;
+        }
+        void stop() { _open = false; }
+        void setTimeout(unsigned long timeout) { (void) timeout; }
+        void setNoDelay(bool nodelay) { (void) nodelay; }
+
+        /* Test hooks: replies of the server for every new client, and where the transmitted data goes */
+        static std::string script;
+        static std::string * sink;
+
+        /* Test hook: replace the pending server replies */
+        void setReplies(const std::string & rx) { _rx = rx; _rxPos = 0; }
+
+    private:
+        std::string _rx;
+        size_t _rxPos;
+        bool _open;
+};
+
+#endif /* SMTPC_SHIM_ESP8266WIFI_H_ */
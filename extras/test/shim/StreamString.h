@@ -0,0 +1 @@
+/* StreamString.h - host shim, not used by the library */
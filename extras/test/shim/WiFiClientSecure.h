@@ -0,0 +1,26 @@
+/**
+ * WiFiClientSecure.h - host shim
+ */
+
+#ifndef SMTPC_SHIM_WIFICLIENTSECURE_H_
+#define SMTPC_SHIM_WIFICLIENTSECURE_H_
+
+#include <ESP8266WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+    public:
+        bool setFingerprint(const char * fpStr) { return fpStr && *fpStr; }
+        void setInsecure() { }
+        void setBufferSizes(int recv, int xmit) { recvBufferSize = recv; (void) xmit; }
+        static bool probeMaxFragmentLength(const char * hostname, uint16_t port, uint16_t len) {
+            (void) hostname; (void) port; (void) len;
+            return mflnSupported;
+        }
+
+        /* Test hooks: receive buffer set by the last setBufferSizes(), 0 for the default,
+         * and whether the server accepts a max fragment length */
+        static int recvBufferSize;
+        static bool mflnSupported;
+};
+
+#endif /* SMTPC_SHIM_WIFICLIENTSECURE_H_ */
@@ -0,0 +1,21 @@
+/**
+ * base64.h - host shim with the interface of the ESP8266 core base64 class
+ *
+ * A plain encoder written for the tests, not the core's libb64: only its output format is the same
+ * (newline every 72 characters by default). It is not a stand-in for measuring the core encoder.
+ */
+
+#ifndef SMTPC_SHIM_BASE64_H_
+#define SMTPC_SHIM_BASE64_H_
+
+#include <Arduino.h>
+
+class base64 {
+    public:
+        static String encode(const uint8_t * data, size_t length, bool doNewLines = true);
+        static String encode(const String & text, bool doNewLines = true) {
+            return encode((const uint8_t *) text.c_str(), text.length(), doNewLines);
+        }
+};
+
+#endif /* SMTPC_SHIM_BASE64_H_ */
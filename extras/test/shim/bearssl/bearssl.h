@@ -0,0 +1,30 @@
+/**
+ * bearssl/bearssl.h - host shim: real SHA-256, RSA signature replaced by the repeated hash
+ */
+
+#ifndef SMTPC_SHIM_BEARSSL_H_
+#define SMTPC_SHIM_BEARSSL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define br_sha256_SIZE 32
+#define BR_HASH_OID_SHA256 ((const unsigned char *) "\x09\x60\x86\x48\x01\x65\x03\x04\x02\x01")
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t count;
+    unsigned char buf[64];
+} br_sha256_context;
+
+void br_sha256_init(br_sha256_context * ctx);
+void br_sha256_update(br_sha256_context * ctx, const void * data, size_t len);
+void br_sha256_out(const br_sha256_context * ctx, void * out);
+
+typedef struct {
+    uint32_t n_bitlen;
+} br_rsa_private_key;
+
+uint32_t br_rsa_i15_pkcs1_sign(const unsigned char * hash_oid, const unsigned char * hash, size_t hash_len, const br_rsa_private_key * sk, unsigned char * x);
+
+#endif /* SMTPC_SHIM_BEARSSL_H_ */
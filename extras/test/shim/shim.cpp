@@ -0,0 +1,144 @@
+/**
+ * shim.cpp - host implementations behind the Arduino/ESP8266 shim headers
+ */
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <base64.h>
+#include <bearssl/bearssl.h>
+#include <chrono>
+
+size_t String::_reserveLimit = (size_t) -1;
+std::string WiFiClient::script;
+std::string * WiFiClient::sink = NULL;
+int WiFiClientSecure::recvBufferSize = 0;
+bool WiFiClientSecure::mflnSupported = true;
+EspClass ESP;
+
+String operator+(const String & lhs, const String & rhs) { String out(lhs); out += rhs; return out; }
+String operator+(const String & lhs, const char * rhs) { String out(lhs); out += rhs; return out; }
+String operator+(const char * lhs, const String & rhs) { String out(lhs); out += rhs; return out; }
+String operator+(const String & lhs, char rhs) { String out(lhs); out += rhs; return out; }
+String operator+(char lhs, const String & rhs) { String out(lhs); out += rhs; return out; }
+
+unsigned long millis(void) {
+    using namespace std::chrono;
+    return (unsigned long) duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void delay(unsigned long ms) { (void) ms; }
+void yield(void) {}
+
+String base64::encode(const uint8_t * data, size_t length, bool doNewLines) {
+    static const char * table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((length + 2) / 3 * 4 + length / 54 + 1);
+    size_t i = 0, groups = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += table[v >> 18];
+        out += table[(v >> 12) & 63];
+        out += table[(v >> 6) & 63];
+        out += table[v & 63];
+        if (doNewLines && ++groups == 18) { /* 72 characters per line */
+            out += '\n';
+            groups = 0;
+        }
+    }
+    if (i < length) {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < length) { v |= data[i + 1] << 8; }
+        out += table[v >> 18];
+        out += table[(v >> 12) & 63];
+        out += (i + 1 < length) ? table[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return String(out.c_str());
+}
+
+static const uint32_t sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void sha256Block(uint32_t * state, const unsigned char * block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (block[4 * i] << 24) | (block[4 * i + 1] << 16) | (block[4 * i + 2] << 8) | block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void br_sha256_init(br_sha256_context * ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->count = 0;
+}
+
+void br_sha256_update(br_sha256_context * ctx, const void * data, size_t len) {
+    const unsigned char * p = (const unsigned char *) data;
+    while (len > 0) {
+        size_t used = ctx->count & 63;
+        size_t n = 64 - used < len ? 64 - used : len;
+        memcpy(ctx->buf + used, p, n);
+        ctx->count += n;
+        p += n;
+        len -= n;
+        if ((ctx->count & 63) == 0) {
+            sha256Block(ctx->state, ctx->buf);
+        }
+    }
+}
+
+void br_sha256_out(const br_sha256_context * ctx, void * out) {
+    br_sha256_context c = *ctx;
+    uint64_t bits = c.count << 3;
+    unsigned char pad[72] = { 0x80 };
+    size_t padLen = ((c.count & 63) < 56 ? 56 : 120) - (c.count & 63);
+    br_sha256_update(&c, pad, padLen);
+    for (int i = 0; i < 8; i++) {
+        pad[i] = (unsigned char) (bits >> (56 - 8 * i));
+    }
+    br_sha256_update(&c, pad, 8);
+    unsigned char * o = (unsigned char *) out;
+    for (int i = 0; i < 8; i++) {
+        o[4 * i] = c.state[i] >> 24;
+        o[4 * i + 1] = c.state[i] >> 16;
+        o[4 * i + 2] = c.state[i] >> 8;
+        o[4 * i + 3] = c.state[i];
+    }
+}
+
+uint32_t br_rsa_i15_pkcs1_sign(const unsigned char * hash_oid, const unsigned char * hash, size_t hash_len, const br_rsa_private_key * sk, unsigned char * x) {
+    (void) hash_oid;
+    size_t len = (sk->n_bitlen + 7) >> 3;
+    for (size_t i = 0; i < len; i++) {
+        x[i] = hash[i % hash_len];
+    }
+    return 1;
+}
@@ -0,0 +1,212 @@
+/**
+ * smtpc_test.h - access to the SMTPClient kernels and naive reference implementations
+ */
+
+#ifndef SMTPC_TEST_H_
+#define SMTPC_TEST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+#include <BearSSLHelpers.h>
+#include <bearssl/bearssl.h>
+
+#include <WiFiClientSecure.h>
+
+#include "ESP8266SMTPClient.h"
+
+/**
+ * SMTPClient with the protected kernels made callable
+ */
+class TestClient : public SMTPClient {
+    public:
+        using SMTPClient::sendPayload;
+        using SMTPClient::addRecipients;
+        using SMTPClient::handleResponse;
+        using SMTPClient::encodeSubject;
+        using SMTPClient::signDKIM;
+
+        /**
+         * attach a connected client, replies are read from rx, data written goes to WiFiClient::sink
+         * @param rx std::string  server replies
+         */
+        void attach(const std::string & rx = "") {
+            if (!_tcp) {
+                _tcp = new WiFiClient();
+            }
+            _tcp->connect("localhost", 25);
+            _tcp->setReplies(rx);
+        }
+        const String & recipients() { return _Recipients; }
+        const String & headers() { return _Headers; }
+};
+
+/**
+ * reference body transfer: one byte at a time, bare LF becomes CRLF, a '.' starting a line is doubled
+ */
+static inline std::string refDotStuff(const std::string & in) {
+    std::string out;
+    bool lineStart = true;
+    for (size_t i = 0; i < in.size(); i++) {
+        if (lineStart && in[i] == '.') { out += '.'; }
+        if (in[i] == '\n' && (i == 0 || in[i - 1] != '\r')) { out += '\r'; }
+        out += in[i];
+        lineStart = (in[i] == '\n');
+    }
+    return out;
+}
+
+/**
+ * reference DKIM simple body canonicalization of a payload: CRLF line ends, no trailing empty lines
+ */
+static inline std::string refSimpleBody(const std::string & payload) {
+    std::string out;
+    for (size_t i = 0; i < payload.size(); i++) {
+        if (payload[i] == '\n' && (i == 0 || payload[i - 1] != '\r')) { out += '\r'; }
+        out += payload[i];
+    }
+    out += "\r\n"; /* CRLF of the end of data sequence ends the last line */
+    while (out.size() >= 4 && out.compare(out.size() - 4, 4, "\r\n\r\n") == 0) {
+        out.resize(out.size() - 2);
+    }
+    return out;
+}
+
+/**
+ * reference DKIM relaxed header canonicalization of one raw field, without CRLF
+ */
+static inline std::string refRelaxedHeader(const std::string & field) {
+    size_t colon = field.find(':');
+    std::string name = field.substr(0, colon), value, out;
+    while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) { name.pop_back(); }
+    for (size_t i = 0; i < name.size(); i++) { out += (char) tolower(name[i]); }
+    for (size_t i = colon + 1; i < field.size(); i++) {
+        if (field[i] == '\r' || field[i] == '\n') { continue; }
+        char c = (field[i] == '\t') ? ' ' : field[i];
+        if (c == ' ' && (value.empty() || value.back() == ' ')) { continue; }
+        value += c;
+    }
+    while (!value.empty() && value.back() == ' ') { value.pop_back(); }
+    return out + ":" + value;
+}
+
+/**
+ * reference reply parsing of the server replies, one reply is read:
+ * every line starts with the same 3 digit code, "xyz-" lines continue the reply,
+ * the texts after "xyz " are joined with '\n' and cut at SMTPCLIENT_MAX_REPLY_LENGTH
+ * @return reply code, SMTPC_ERROR_NO_SMTP_SERVER or SMTPC_ERROR_READ_TIMEOUT
+ */
+static inline int refParseReply(const std::string & rx, std::string & msg) {
+    int code = -1;
+    msg.clear();
+    for (size_t pos = 0; ; ) {
+        size_t eol = rx.find('\n', pos);
+        std::string line = rx.substr(pos, eol == std::string::npos ? std::string::npos : eol - pos);
+        pos = (eol == std::string::npos) ? rx.size() : eol + 1;
+        if (code > 0 && line.empty()) { /* Nothing more before the stream timeout */
+            return SMTPC_ERROR_READ_TIMEOUT;
+        }
+        if (line.size() < 3 || line[0] < '1' || line[0] > '5' || !isdigit((unsigned char) line[1]) || !isdigit((unsigned char) line[2])) {
+            return SMTPC_ERROR_NO_SMTP_SERVER;
+        }
+        int lineCode = atoi(line.substr(0, 3).c_str());
+        if (code > 0 && lineCode != code) {
+            return SMTPC_ERROR_NO_SMTP_SERVER;
+        }
+        if (line.back() == '\r') { line.pop_back(); }
+        if (code > 0) { msg += '\n'; }
+        if (line.size() > 4) { msg += line.substr(4); }
+        code = lineCode;
+        if (line.size() < 4 || line[3] != '-') {
+            break;
+        }
+    }
+    if (msg.size() > SMTPCLIENT_MAX_REPLY_LENGTH) { msg.resize(SMTPCLIENT_MAX_REPLY_LENGTH); }
+    return code;
+}
+
+/**
+ * reference base64 decoding, false on characters outside the alphabet or a bad length
+ */
+static inline bool refDecodeBase64(const std::string & in, std::string & out) {
+    static const std::string table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    out.clear();
+    if (in.size() % 4) { return false; }
+    for (size_t i = 0; i < in.size(); i += 4) {
+        uint32_t v = 0;
+        int pad = 0;
+        for (size_t j = 0; j < 4; j++) {
+            size_t k = table.find(in[i + j]);
+            if (in[i + j] == '=' && i + 4 == in.size() && j >= 2) {
+                k = 0;
+                pad++;
+            } else if (k == std::string::npos || pad) {
+                return false;
+            }
+            v = (v << 6) | (uint32_t) k;
+        }
+        out += (char) (v >> 16);
+        if (pad < 2) { out += (char) (v >> 8); }
+        if (pad < 1) { out += (char) v; }
+    }
+    return true;
+}
+
+/**
+ * reference check of an encoded Subject value: RFC 2047 words of at most 75 characters
+ * folded with CRLF SP, "Subject: " plus the first word within 76 characters
+ * @param words std::vector<std::string> *  receives the decoded text of each word (may be NULL)
+ * @return the decoded subject, false in ok if the value is malformed
+ */
+static inline std::string refDecodeSubject(const std::string & value, bool & ok, std::vector<std::string> * words = NULL) {
+    std::string text, chunk;
+    ok = true;
+    for (size_t pos = 0; pos < value.size(); ) {
+        size_t eol = value.find("\r\n ", pos);
+        if (eol == std::string::npos) { eol = value.size(); }
+        std::string word = value.substr(pos, eol - pos);
+        if (word.size() > 75 || (pos == 0 && word.size() > 76 - 9)
+                || word.compare(0, 10, "=?UTF-8?B?") != 0 || word.size() < 12
+                || word.compare(word.size() - 2, 2, "?=") != 0
+                || !refDecodeBase64(word.substr(10, word.size() - 12), chunk) || chunk.empty()) {
+            ok = false;
+            return text;
+        }
+        if (words) { words->push_back(chunk); }
+        text += chunk;
+        pos = (eol == value.size()) ? eol : eol + 3;
+    }
+    return text;
+}
+
+/**
+ * reference address splitting: commas outside of "..." and <...> separate addresses,
+ * a backslash inside "..." escapes the next character, the input ends at the first NUL
+ */
+static inline std::string refSplitRecipients(const char * to) {
+    std::string out(to);
+    bool quoted = false, angle = false;
+    for (size_t i = 0; i < out.size(); i++) {
+        char c = out[i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (quoted && c == '\\') {
+            i++;
+        } else if (!quoted && !angle && c == '<') {
+            angle = true;
+        } else if (!quoted && angle && c == '>') {
+            angle = false;
+        } else if (!quoted && !angle && c == ',') {
+            out[i] = '\n';
+        }
+    }
+    return out;
+}
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#endif /* SMTPC_TEST_H_ */
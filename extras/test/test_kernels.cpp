@@ -0,0 +1,205 @@
+/**
+ * test_kernels.cpp - regression cases for the byte-level kernels of SMTPClient
+ */
+
+#include <vector>
+
+#include "smtpc_test.h"
+
+static int failures = 0;
+
+static std::string stuffed(const std::string & in) {
+    std::string out;
+    WiFiClient::sink = &out;
+    TestClient smtp;
+    smtp.attach();
+    /* Exact-size heap copy, so reading past size is caught by the sanitizers */
+    char * buf = (char *) malloc(in.size() + 1);
+    memcpy(buf, in.data(), in.size());
+    CHECK(smtp.sendPayload(buf, in.size()));
+    free(buf);
+    WiFiClient::sink = NULL;
+    return out;
+}
+
+static std::string split(const char * to) {
+    TestClient smtp;
+    CHECK(smtp.addRecipients(to));
+    return smtp.recipients().c_str();
+}
+
+static void testDotStuffing() {
+    static const char * cases[] = {
+        "", ".", "..", "a", "a\n", "\n.", "a\r\n.\r\nb", ".start\r\n", "x\n..y\n.", "\n\n\n.", "no dots at all\r\n"
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        CHECK(stuffed(cases[i]) == refDotStuff(cases[i]));
+    }
+    CHECK(stuffed("a\r\n.\r\nb") == "a\r\n..\r\nb");
+    CHECK(stuffed(".") == "..");
+    CHECK(stuffed("a\nb\n") == "a\r\nb\r\n");
+    CHECK(stuffed("a\n.b") == "a\r\n..b");
+
+    /* Binary body: NUL bytes are data, size bounds the scan */
+    std::string binary("\0\n.\0\n", 5);
+    CHECK(stuffed(binary) == std::string("\0\r\n..\0\r\n", 8));
+}
+
+static void testRecipients() {
+    CHECK(split("a@example.com") == "a@example.com");
+    CHECK(split("a@example.com, b@example.com") == "a@example.com\n b@example.com");
+    CHECK(split("\"Doe, John\" <j@example.com>, x@example.com") == "\"Doe, John\" <j@example.com>\n x@example.com");
+    CHECK(split("\"a\\\",b\" <x@example.com>,y@example.com") == "\"a\\\",b\" <x@example.com>\ny@example.com");
+    /* A comma inside <...> does not split, the state is kept in more than one bit */
+    CHECK(split("<a,b@example.com>, c@example.com") == "<a,b@example.com>\n c@example.com");
+    CHECK(split("Name <a@example.com>,Other <b@example.com>") == "Name <a@example.com>\nOther <b@example.com>");
+}
+
+static void testResponse() {
+    TestClient smtp;
+    smtp.attach("250-first\r\n250-second\r\n250 last\r\n");
+    CHECK(smtp.handleResponse() == 250);
+    CHECK(String(smtp.getErrorMessage()) == "first\nsecond\nlast");
+
+    smtp.attach("250-first\r\n251 other code\r\n");
+    CHECK(smtp.handleResponse() == SMTPC_ERROR_NO_SMTP_SERVER);
+
+    smtp.attach("250-first\r\n");
+    CHECK(smtp.handleResponse() == SMTPC_ERROR_READ_TIMEOUT);
+
+    /* A long multiline reply keeps only its start */
+    std::string reply, msg;
+    for (int i = 0; i < 30; i++) {
+        reply += "250-" + std::string(40, 'a' + i % 26) + "\r\n";
+    }
+    reply += "250 end\r\n";
+    smtp.attach(reply);
+    CHECK(smtp.handleResponse() == refParseReply(reply, msg));
+    CHECK(msg.size() == SMTPCLIENT_MAX_REPLY_LENGTH && msg == smtp.getErrorMessage());
+
+    smtp.attach("354 go ahead\r\n");
+    CHECK(smtp.handleResponse() == 354);
+    CHECK(String(smtp.getErrorMessage()) == "go ahead");
+
+    smtp.attach("hello\r\n");
+    CHECK(smtp.handleResponse() == SMTPC_ERROR_NO_SMTP_SERVER);
+}
+
+static void testSendMessage() {
+    std::string out;
+    WiFiClient::sink = &out;
+    WiFiClient::script = "220 hi\r\n250 ok\r\n250 ok\r\n250 ok\r\n354 go\r\n250 queued\r\n";
+    SMTPClient smtp;
+    smtp.begin("localhost", 25);
+    CHECK(smtp.sendMessage("a@example.com", "line\r\n.\r\n", 0, "b@example.com") == 250);
+    CHECK(out.find("MAIL FROM: <a@example.com>\r\n") != std::string::npos);
+    CHECK(out.find("RCPT TO: <b@example.com>\r\n") != std::string::npos);
+    CHECK(out.find("\r\n\r\nline\r\n..\r\n\r\n.\r\n") != std::string::npos);
+    WiFiClient::sink = NULL;
+    WiFiClient::script = "";
+}
+
+static std::string sha256(const std::string & data) {
+    br_sha256_context ctx;
+    unsigned char hash[br_sha256_SIZE];
+    br_sha256_init(&ctx);
+    br_sha256_update(&ctx, data.data(), data.size());
+    br_sha256_out(&ctx, hash);
+    return std::string((const char *) hash, sizeof(hash));
+}
+
+static std::string b64(const std::string & data) {
+    return base64::encode((const uint8_t *) data.data(), data.size(), false).c_str();
+}
+
+static std::string tag(const std::string & dkim, const char * name) {
+    std::string key = std::string("; ") + name + "=";
+    size_t pos = dkim.find(key);
+    if (pos == std::string::npos) { return ""; }
+    pos += key.size();
+    size_t end = dkim.find(';', pos);
+    return dkim.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+static void testDKIM(const char * subject) {
+    std::string out;
+    WiFiClient::sink = &out;
+    WiFiClient::script = "220 hi\r\n250 ok\r\n250 ok\r\n250 ok\r\n354 go\r\n250 queued\r\n";
+    SMTPClient smtp;
+    smtp.begin("localhost", 25);
+    CHECK(smtp.setDKIM("example.com", "sel", "key"));
+    smtp.addHeader("Content-Type", "text/plain;\r\n\tcharset=UTF-8");
+    const char * body = "Hello\n.\nBare LF lines\n\n\n";
+    CHECK(smtp.sendMessage("a@example.com", body, 0, "b@example.com", subject) == 250);
+    CHECK(out.find("\r\n\r\nHello\r\n..\r\nBare LF lines\r\n\r\n\r\n\r\n.\r\n") != std::string::npos);
+
+    size_t begin = out.find("DKIM-Signature: ");
+    size_t end = out.find("\r\n\r\n", begin);
+    CHECK(begin != std::string::npos && end != std::string::npos);
+    std::string block = out.substr(begin, end + 2 - begin);
+    for (size_t i = 0; i < block.size(); i++) {
+        CHECK(block[i] != '\n' || (i > 0 && block[i - 1] == '\r'));
+    }
+
+    /* Raw fields, continuation lines belong to the field above */
+    std::vector<std::string> fields;
+    for (size_t pos = 0; pos < block.size(); ) {
+        size_t eol = block.find("\r\n", pos);
+        std::string line = block.substr(pos, eol + 2 - pos);
+        if (line[0] == ' ' || line[0] == '\t') {
+            fields.back() += line;
+        } else {
+            fields.push_back(line);
+        }
+        pos = eol + 2;
+    }
+    CHECK(fields.size() == 6);
+    if (fields.size() != 6) { return; }
+    std::string dkim = fields[0].substr(0, fields[0].size() - 2);
+
+    /* Folded into whole UTF-8 characters per encoded word */
+    CHECK(fields[3].compare(0, 9, "Subject: ") == 0);
+    bool ok;
+    std::vector<std::string> words;
+    CHECK(refDecodeSubject(fields[3].substr(9, fields[3].size() - 11), ok, &words) == subject && ok);
+    CHECK(strlen(subject) <= SMTPCLIENT_SUBJECT_FIRST_BYTES || words.size() > 1);
+    for (size_t i = 0; i < words.size(); i++) {
+        CHECK((words[i][0] & 0xC0) != 0x80);
+    }
+
+    CHECK(tag(dkim, "c") == "relaxed/simple");
+    CHECK(tag(dkim, "h") == "to:x-mailer:subject:from:content-type");
+    CHECK(tag(dkim, "bh") == b64(sha256(refSimpleBody(body))));
+
+    std::string signedData;
+    for (size_t i = fields.size() - 1; i > 0; i--) {
+        signedData += refRelaxedHeader(fields[i]) + "\r\n";
+    }
+    size_t b = dkim.rfind("; b=") + 4;
+    signedData += refRelaxedHeader(dkim.substr(0, b));
+    /* The shim signature is the signed hash repeated over the 2048 bit modulus */
+    std::string hash = sha256(signedData), sig;
+    while (sig.size() < 256) { sig += hash; }
+    CHECK(dkim.substr(b) == b64(sig));
+
+    WiFiClient::sink = NULL;
+    WiFiClient::script = "";
+}
+
+int main() {
+    testDotStuffing();
+    testRecipients();
+    testResponse();
+    testSendMessage();
+    /* Long enough to make the core encoder break the base64 line */
+    testDKIM("A subject that is long enough to need more than one base64 line");
+    /* Several encoded words, multibyte characters straddling the word boundaries */
+    testDKIM("Größenänderung der Überschrift für 日本語のテキストと絵文字 \xF0\x9F\x93\xA7 "
+             "— eine wirklich lange Betreffzeile, die über mehrere Wörter gefaltet wird 📧📧📧");
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
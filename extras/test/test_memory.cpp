@@ -0,0 +1,162 @@
+/**
+ * test_memory.cpp - memory budget preflight and allocation failure handling
+ */
+
+#include "smtpc_test.h"
+
+static int failures = 0;
+static const char * replies = "220 hi\r\n250 ok\r\n250 ok\r\n250 ok\r\n354 go\r\n250 queued\r\n";
+
+static void testAddHeader() {
+    TestClient smtp;
+    CHECK(smtp.addHeader("A", "1"));
+    CHECK(smtp.addHeader("B", "2", true));
+    CHECK(smtp.headers() == "B: 2\r\nA: 1\r\n");
+
+    String::_reserveLimit = 16;
+    CHECK(!smtp.addHeader("C", "value too long for the heap", true));
+    CHECK(smtp.headers() == "B: 2\r\nA: 1\r\n");
+    CHECK(!smtp.addRecipient("recipient@otherdomain.example"));
+    CHECK(smtp.recipients() == "");
+    String::_reserveLimit = (size_t) -1;
+}
+
+static void testBudget() {
+    std::string out;
+    WiFiClient::sink = &out;
+    WiFiClient::script = replies;
+    ESP.freeHeap = 100000;
+    ESP.maxFreeBlock = 100000;
+
+    SMTPClient smtp;
+    smtp.begin("localhost", 25);
+    smtp.setMemoryBudget(100);
+    CHECK(smtp.estimateMemory("a@example.com", "b@example.com") > 100);
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == SMTPC_ERROR_TOO_LESS_RAM);
+    CHECK(out.empty());
+
+    smtp.setMemoryBudget(8192);
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == 250);
+
+    WiFiClient::sink = NULL;
+    WiFiClient::script = "";
+}
+
+static void testFragmentedHeap() {
+    std::string out;
+    WiFiClient::sink = &out;
+    WiFiClient::script = replies;
+    ESP.freeHeap = 100000;
+    ESP.maxFreeBlock = 3000;
+
+    /* Enough free heap in total, but no block for the TLS buffers, not even the reduced ones */
+    SMTPClient smtp;
+    smtp.begin("localhost", 465);
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == SMTPC_ERROR_TOO_LESS_RAM);
+    CHECK(out.empty());
+
+    /* The reduced buffers fit, but the server can't limit its records to them */
+    ESP.maxFreeBlock = 8000;
+    WiFiClientSecure::mflnSupported = false;
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == SMTPC_ERROR_TOO_LESS_RAM);
+    CHECK(out.empty());
+
+    /* Degrades to the reduced buffers */
+    WiFiClientSecure::mflnSupported = true;
+    WiFiClientSecure::recvBufferSize = 0;
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == 250);
+    CHECK(WiFiClientSecure::recvBufferSize == SMTPCLIENT_TLS_REDUCED_BUFFER);
+
+    /* Full buffers when they fit */
+    SMTPClient full;
+    full.begin("localhost", 465);
+    ESP.maxFreeBlock = 20000;
+    WiFiClientSecure::recvBufferSize = 0;
+    CHECK(full.sendMessage("a@example.com", "body", 0, "b@example.com") == 250);
+    CHECK(WiFiClientSecure::recvBufferSize == 0);
+
+    ESP.freeHeap = 40000;
+    ESP.maxFreeBlock = 30000;
+    WiFiClient::sink = NULL;
+    WiFiClient::script = "";
+}
+
+static void testReducedBudget() {
+    WiFiClient::script = replies;
+    ESP.freeHeap = 100000;
+    ESP.maxFreeBlock = 100000;
+    WiFiClientSecure::recvBufferSize = 0;
+
+    /* The full TLS estimate exceeds the budget, the reduced one fits */
+    SMTPClient smtp;
+    smtp.begin("localhost", 465);
+    smtp.setMemoryBudget(SMTPCLIENT_TLS_RAM_ESTIMATE - 1024);
+    CHECK(smtp.estimateMemory("a@example.com", "b@example.com") > SMTPCLIENT_TLS_RAM_ESTIMATE - 1024);
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == 250);
+    CHECK(WiFiClientSecure::recvBufferSize == SMTPCLIENT_TLS_REDUCED_BUFFER);
+
+    /* Not even the reduced connection fits */
+    SMTPClient small;
+    small.begin("localhost", 465);
+    small.setMemoryBudget(SMTPCLIENT_TLS_REDUCED_RAM_ESTIMATE);
+    CHECK(small.sendMessage("a@example.com", "body", 0, "b@example.com") == SMTPC_ERROR_TOO_LESS_RAM);
+
+    ESP.freeHeap = 40000;
+    ESP.maxFreeBlock = 30000;
+    WiFiClient::script = "";
+}
+
+static void testDKIMThunk() {
+    std::string out;
+    WiFiClient::sink = &out;
+    WiFiClient::script = replies;
+    ESP.maxFreeBlock = SMTPCLIENT_THUNK_RAM_ESTIMATE - 1;
+
+    /* Checked without a budget: the BearSSL stack for the signature doesn't fit */
+    TestClient smtp;
+    smtp.begin("localhost", 25);
+    CHECK(smtp.setDKIM("example.com", "sel", "key"));
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == SMTPC_ERROR_TOO_LESS_RAM);
+    CHECK(out.empty());
+
+    /* The heap fragmented after the preflight */
+    CHECK(smtp.signDKIM("body", 4) == SMTPC_ERROR_TOO_LESS_RAM);
+    ESP.maxFreeBlock = SMTPCLIENT_THUNK_RAM_ESTIMATE;
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == 250);
+
+    ESP.maxFreeBlock = 30000;
+    WiFiClient::sink = NULL;
+    WiFiClient::script = "";
+}
+
+static void testDKIMOutOfMemory() {
+    std::string out;
+    WiFiClient::sink = &out;
+    WiFiClient::script = replies;
+
+    SMTPClient smtp;
+    smtp.begin("localhost", 25);
+    CHECK(smtp.setDKIM("example.com", "sel", "key"));
+    String::_reserveLimit = 300;
+    CHECK(smtp.sendMessage("a@example.com", "body", 0, "b@example.com") == SMTPC_ERROR_TOO_LESS_RAM);
+    CHECK(out.find("DATA") == std::string::npos);
+    String::_reserveLimit = (size_t) -1;
+
+    WiFiClient::sink = NULL;
+    WiFiClient::script = "";
+}
+
+int main() {
+    testAddHeader();
+    testBudget();
+    testFragmentedHeap();
+    testReducedBudget();
+    testDKIMThunk();
+    testDKIMOutOfMemory();
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
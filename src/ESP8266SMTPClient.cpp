@@ -24,11 +24,29 @@
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
 #include <WiFiClientSecure.h>
+#include <BearSSLHelpers.h>
+#include <bearssl/bearssl.h>
 #include <StreamString.h>
 #include <base64.h>
+#include <new>
+#include <algorithm>
+#ifdef ESP8266
+#include <StackThunk.h>
+#endif
 
 #include "ESP8266SMTPClient.h"
 
+#ifdef ESP8266
+/* RSA private key operation runs on the BearSSL stack, it needs more than the cont stack can spare */
+extern "C" {
+  extern uint32_t thunk_br_rsa_i15_pkcs1_sign(const unsigned char * hash_oid, const unsigned char * hash, size_t hash_len, const br_rsa_private_key * sk, unsigned char * x);
+};
+make_stack_thunk(br_rsa_i15_pkcs1_sign);
+#define dkim_rsa_pkcs1_sign thunk_br_rsa_i15_pkcs1_sign
+#else
+#define dkim_rsa_pkcs1_sign br_rsa_i15_pkcs1_sign
+#endif
+
 /**
  * constractor
  */
@@ -39,6 +57,11 @@ SMTPClient::SMTPClient() {
     _tcpTimeout = SMTPCLIENT_DEFAULT_TCP_TIMEOUT;
     _smtps = false;
     _mailer = "ESP8266SMTPClient";
+    _dkimKey = NULL;
+    _memBudget = 0;
+    _memBase = 0;
+    _memHighWater = 0;
+    _tlsReduced = false;
     _returnCode = 0;
 }
 
@@ -56,6 +79,7 @@ SMTPClient::~SMTPClient() {
         delete _tcp;
         _tcp = NULL;
     }
+    clearDKIM();
 }
 
 /**
@@ -121,6 +145,45 @@ void SMTPClient::setMailer(const char * mailer) {
     _mailer = mailer;
 }
 
+/**
+ * enable DKIM signing (rsa-sha256, c=relaxed/simple) of the sent messages
+ * Bare LF line ends of the body are sent and signed as CRLF.
+ * Signing blocks sendMessage() and does not yield. The time has not been measured on a device;
+ * as an unverified estimate a 2048 bit key takes around a second at 80 MHz, a 1024 bit key
+ * several times less. Keep it well below the ~3 s software watchdog.
+ * @param domain const char *      signing domain (d= tag)
+ * @param selector const char *    key selector (s= tag)
+ * @param privateKey const char *  RSA private key in PEM format
+ * @return false if the key can not be used for signing
+ */
+bool SMTPClient::setDKIM(const char * domain, const char * selector, const char * privateKey) {
+    clearDKIM();
+    if(!domain || !selector || !privateKey) {
+        return false;
+    }
+    _dkimKey = new (std::nothrow) BearSSL::PrivateKey(privateKey);
+    if(!_dkimKey || !_dkimKey->isRSA()) {
+        DEBUG_SMTPCLIENT("[SMTP-Client][setDKIM] no usable RSA key\n");
+        clearDKIM();
+        return false;
+    }
+    _dkimDomain = domain;
+    _dkimSelector = selector;
+    return true;
+}
+
+/**
+ * disable DKIM signing
+ */
+void SMTPClient::clearDKIM(void) {
+    if(_dkimKey) {
+        delete _dkimKey;
+        _dkimKey = NULL;
+    }
+    _dkimDomain = "";
+    _dkimSelector = "";
+}
+
 /**
  * set the Authorizatio for the smtp request
  * @param user const char *
@@ -128,8 +191,164 @@ void SMTPClient::setMailer(const char * mailer) {
  */
 void SMTPClient::setAuthorization(const char * user, const char * password) {
     if(user && password) {
-        _base64User = base64::encode(user);
-        _base64Pass = base64::encode(password);
+        _base64User = base64::encode(user, false);
+        _base64Pass = base64::encode(password, false);
+    }
+}
+
+/**
+ * limit the heap a single sendMessage() may use
+ * Messages whose estimated peak does not fit into the budget (or into the free heap)
+ * are rejected with SMTPC_ERROR_TOO_LESS_RAM before anything is sent, a new smtps
+ * connection first falls back to SMTPCLIENT_TLS_REDUCED_BUFFER.
+ * @param budget size_t  bytes, 0 disables the check
+ */
+void SMTPClient::setMemoryBudget(size_t budget) {
+    _memBudget = budget;
+}
+
+/**
+ * estimates the peak heap use of sendMessage()
+ * The body is sent straight from the caller's buffer and needs no extra RAM.
+ * A new smtps connection is counted with the reduced buffers once sendMessage() fell back to them.
+ * @param from const char *     Sender E-mail address
+ * @param to const char *       Recepient E-mail address (may be NULL)
+ * @param subject const char *  Message subject (may be NULL)
+ * @return bytes
+ */
+size_t SMTPClient::estimateMemory(const char * from, const char * to, const char * subject) {
+    size_t toLen = to ? strlen(to) : 0;
+    size_t headers = headersLength(from, to, subject);
+    size_t mem = 0;
+
+    if (!connected() && _smtps) {
+      mem += _tlsReduced ? SMTPCLIENT_TLS_REDUCED_RAM_ESTIMATE : SMTPCLIENT_TLS_RAM_ESTIMATE;
+    } else if (!connected()) {
+      mem += SMTPCLIENT_TCP_RAM_ESTIMATE;
+    }
+    // header block, recipient table and the temporary copy made while splitting
+    mem += headers + _Recipients.length() + 2 * toLen;
+    if (_dkimKey) {
+      // signature, its base64 form, the DKIM-Signature value and its canonical form, the h= list
+      size_t siglen = (_dkimKey->getRSA()->n_bitlen + 7) >> 3;
+      mem += siglen + 3 * (siglen / 3 * 4 + 4) + headers + 512 + SMTPCLIENT_THUNK_RAM_ESTIMATE;
+    }
+    return mem;
+}
+
+/**
+ * BearSSL stack still to be allocated for a TLS connection or the DKIM signature
+ * @return bytes, 0 if it is already in use
+ */
+static size_t thunkBlock(void) {
+#ifdef ESP8266
+    if (stack_thunk_get_refcnt() > 0) {
+      return 0;
+    }
+#endif
+    return SMTPCLIENT_THUNK_RAM_ESTIMATE;
+}
+
+/**
+ * largest single allocation sendMessage() has ahead: the buffers of a new connection,
+ * the BearSSL stack of a new smtps connection or of the DKIM signature
+ * @return bytes
+ */
+size_t SMTPClient::largestBlock(void) {
+    size_t block = 0;
+    if (!connected()) {
+      if (!_smtps) {
+        block = SMTPCLIENT_TCP_BLOCK_ESTIMATE;
+      } else {
+        block = _tlsReduced ? SMTPCLIENT_TLS_REDUCED_BLOCK_ESTIMATE : SMTPCLIENT_TLS_BLOCK_ESTIMATE;
+      }
+    }
+    if (_dkimKey || (_smtps && !connected())) {
+      block = std::max(block, thunkBlock());
+    }
+    return block;
+}
+
+/**
+ * preflight of sendMessage(): the largest allocation has to fit into the largest free heap block,
+ * with a budget set the estimated peak has to fit into it and into the free heap
+ * @return true if the message can be sent
+ */
+bool SMTPClient::fitsMemory(const char * from, const char * to, const char * subject) {
+    size_t block = largestBlock();
+    if (ESP.getMaxFreeBlockSize() < block) {
+      DEBUG_SMTPCLIENT("[SMTP-Client][sendMessage] needs a %u byte block, largest free is %u\n", block, ESP.getMaxFreeBlockSize());
+      return false;
+    }
+    if (_memBudget) {
+      size_t needed = estimateMemory(from, to, subject);
+      size_t avail = _memBase < _memBudget ? _memBase : _memBudget;
+      if (needed > avail) {
+        DEBUG_SMTPCLIENT("[SMTP-Client][sendMessage] needs %u bytes of RAM, %u available\n", needed, avail);
+        return false;
+      }
+    }
+    return true;
+}
+
+/**
+ * length of the header block once sendMessage() adds From, Subject (base64), X-Mailer, To and DKIM-Signature
+ * @return bytes
+ */
+size_t SMTPClient::headersLength(const char * from, const char * to, const char * subject) {
+    size_t len = _Headers.length() + _mailer.length() + 64;
+    if (from) { len += strlen(from); }
+    if (to) { len += strlen(to); }
+    if (subject) { len += (strlen(subject) / (SMTPCLIENT_SUBJECT_FIRST_BYTES - 3) + 1) * 75 + 16; }
+    if (_dkimKey) {
+      // tags, bh= and b= in base64, h= holds the field names
+      size_t siglen = (_dkimKey->getRSA()->n_bitlen + 7) >> 3;
+      len += 128 + _dkimDomain.length() + _dkimSelector.length() + (siglen + 2) / 3 * 4 + len / 4;
+    }
+    return len;
+}
+
+/**
+ * encodes the subject as RFC 2047 encoded words folded with CRLF SP, each word at most 75 characters
+ * Words end on whole UTF-8 characters, so every word decodes on its own.
+ * @param out String &          encoded subject
+ * @param subject const char *  UTF-8 subject
+ * @return false if out of RAM
+ */
+bool SMTPClient::encodeSubject(String & out, const char * subject) {
+    size_t len = strlen(subject), pos = 0;
+    size_t max = SMTPCLIENT_SUBJECT_FIRST_BYTES;
+    out = "";
+    if (!out.reserve((len / (SMTPCLIENT_SUBJECT_FIRST_BYTES - 3) + 1) * 75)) {
+      return false;
+    }
+    while (pos < len) {
+      size_t n = len - pos;
+      if (n > max) {
+        n = max;
+        while (n > 0 && (subject[pos + n] & 0xC0) == 0x80) { n--; } /* Don't split a UTF-8 character */
+        if (n == 0) { n = max; } /* Not UTF-8, split anyway */
+      }
+      String word = base64::encode((uint8_t *) &subject[pos], n, false);
+      if (word.length() == 0
+          || (pos > 0 && !out.concat("\r\n "))
+          || !out.concat("=?UTF-8?B?") || !out.concat(word) || !out.concat("?=")) {
+        return false;
+      }
+      pos += n;
+      max = SMTPCLIENT_SUBJECT_WORD_BYTES;
+    }
+    return true;
+}
+
+/**
+ * samples the heap used since the start of sendMessage()
+ * Called at the allocation peaks, the result is the highest sample, not an exact peak.
+ */
+void SMTPClient::trackMemory(void) {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < _memBase && _memBase - freeHeap > _memHighWater) {
+      _memHighWater = _memBase - freeHeap;
     }
 }
 
@@ -167,24 +386,58 @@ int SMTPClient::sendMessage(const char * from, String & payload, const char * to
  */
 int SMTPClient::sendMessage(const char * from, const char * payload, size_t size, const char * to, const char * subject) {    
     String command;
-    if (size==0) { size = strlen(payload); } 
+    if (size==0 && payload) { size = strlen(payload); } 
+
+    _memBase = ESP.getFreeHeap();
+    _memHighWater = 0;
+    size_t headersLen = headersLength(from, to, subject);
+    /* A fragmented heap may have enough free RAM, but not the buffers of a new connection,
+     * a new smtps connection then tries smaller buffers */
+    if (!connected()) {
+      _tlsReduced = false;
+      if (_smtps && !fitsMemory(from, to, subject)) {
+        DEBUG_SMTPCLIENT("[SMTP-Client][sendMessage] trying %u byte TLS buffers\n", SMTPCLIENT_TLS_REDUCED_BUFFER);
+        _tlsReduced = true;
+      }
+    }
+    if (!fitsMemory(from, to, subject)) {
+      return SMTPC_ERROR_TOO_LESS_RAM;
+    }
 
     if (!connected()) {
       if(!connect()) {
-          return returnError(SMTPC_ERROR_CONNECTION_REFUSED);
+          return returnError(_tcp ? SMTPC_ERROR_CONNECTION_REFUSED : SMTPC_ERROR_TOO_LESS_RAM);
       }     
     }
+    trackMemory();
 
-    addHeader("From", from);
+    /* Grow the header block once instead of on every addHeader() */
+    if (!_Headers.reserve(headersLen)) {
+      return SMTPC_ERROR_TOO_LESS_RAM;
+    }
+    bool added = addHeader("From", from);
     if (subject) { 
-      String subj2 = subject;
-      subj2 = "=?UTF-8?B?" + base64::encode(subj2) + "?=";
-      addHeader("Subject", subj2); 
+      String subj2;
+      added = added && encodeSubject(subj2, subject);
+      trackMemory();
+      added = added && addHeader("Subject", subj2);
     }
-    addHeader("X-Mailer", _mailer);
+    added = added && addHeader("X-Mailer", _mailer);
     if (to) { 
-      addHeader("To", to);
-      addRecipients(to); 
+      added = added && addHeader("To", to) && addRecipients(to);
+    }
+    if (!added) {
+      clearRecipients();
+      clearHeaders();
+      return SMTPC_ERROR_TOO_LESS_RAM;
+    }
+    trackMemory();
+
+    int dkimError = _dkimKey ? signDKIM(payload, size) : 0;
+    if (dkimError < 0) {
+      clearRecipients();
+      clearHeaders();
+      return dkimError;
     }
 
     _returnCode = sendAddress("MAIL FROM: ", from);
@@ -223,29 +476,18 @@ int SMTPClient::sendMessage(const char * from, const char * payload, size_t size
     if(!sendHeaders()) {
         return returnError(SMTPC_ERROR_SEND_HEADER_FAILED);
     }
+    trackMemory();
 
     // send Payload if needed
-    DEBUG_SMTPCLIENT("[SMTP-Client][sendMessage] message: '%s'\n", payload);
+    DEBUG_SMTPCLIENT("[SMTP-Client][sendMessage] message: %u bytes\n", size);
     if(payload && size > 0) {
-        char * ptr;
-        static const char * alternative = "\n..";
-        const int alen = strlen(alternative);
-        while (ptr=strstr(payload,"\n.")) {
-          size_t pos = ptr-payload;
-          size -= pos + alen;
-          if(_tcp->write(&payload[0], pos) != pos) {
-              return returnError(SMTPC_ERROR_SEND_PAYLOAD_FAILED);
-          }
-          if(_tcp->write(alternative, 4) != 4) {
-              return returnError(SMTPC_ERROR_SEND_PAYLOAD_FAILED);
-          }
-          payload = ptr + alen;
-        }
-        if(_tcp->write(&payload[0], size) != size) {
+        if(!sendPayload(payload, size)) {
             return returnError(SMTPC_ERROR_SEND_PAYLOAD_FAILED);
         }
     }
 	_returnCode = sendRequest("\r\n.");
+    trackMemory();
+    DEBUG_SMTPCLIENT("[SMTP-Client][sendMessage] RAM high-water mark: %u bytes\n", _memHighWater);
     
     /* Reset recepients after sending them */
     clearRecipients();
@@ -269,12 +511,12 @@ int SMTPClient::sendAddress(const char *cmd, const char *address) {
       command += a2;
       command += '>';
     }
+    trackMemory();
     _returnCode = sendRequest(command);
     if (_returnCode < 0 || _returnCode >= 400) { 
       DEBUG_SMTPCLIENT("[SMTP-Client][sendAddress] failed command: '%s'\n", command.c_str());      
-      return _returnCode;
     }
-  
+    return _returnCode;
 }
 
 
@@ -326,6 +568,8 @@ String SMTPClient::errorToString(int error) {
             return String("invalid recepient address");        
         case SMTPC_ERROR_INVALID_ENVELOPE:
             return String("error in E-mail envelope");        
+        case SMTPC_ERROR_DKIM_FAILED:
+            return String("DKIM signing failed");
         default:
             return String();
     }
@@ -336,18 +580,21 @@ String SMTPClient::errorToString(int error) {
  * @param name
  * @param value
  * @param first
+ * @return false if there is not enough RAM, the headers are left unchanged
  */
-void SMTPClient::addHeader(const String& name, const String& value, bool first) {
-    String headerLine = name;
-    headerLine += ": ";
-	headerLine += value;
-	headerLine += "\r\n";
+bool SMTPClient::addHeader(const String& name, const String& value, bool first) {
+    size_t len = _Headers.length();
+    if (!_Headers.reserve(len + name.length() + value.length() + 4) ||
+        !_Headers.concat(name) || !_Headers.concat(": ") || !_Headers.concat(value) || !_Headers.concat(nl)) {
+        DEBUG_SMTPCLIENT("[SMTP-Client][addHeader] not enough RAM for header %s\n", name.c_str());
+        return false;
+    }
 
-	if(first) {
-		_Headers = headerLine + _Headers;
-	} else {
-		_Headers += headerLine;
+	if(first && len) { /* Move the new line to the front inside the same buffer */
+		char * hdr = &_Headers[0];
+		std::rotate(hdr, hdr + len, hdr + _Headers.length());
 	}
+	return true;
 }
 
 
@@ -355,8 +602,8 @@ void SMTPClient::addHeader(const String& name, const String& value, bool first)
  * adds Header to the request
  * @param to String - recepients to split
  */
-void SMTPClient::addRecipients(String & to) {
-	addRecipients(to.c_str());
+bool SMTPClient::addRecipients(String & to) {
+	return addRecipients(to.c_str());
 }
 
 /**
@@ -365,12 +612,14 @@ void SMTPClient::addRecipients(String & to) {
  * @param value
  * @param first
  */
-void SMTPClient::addRecipients(const char * to) {
-	uint16_t len = strlen(to);
+bool SMTPClient::addRecipients(const char * to) {
+	size_t len = strlen(to);
 	char * to2 = strdup(to);
-	boolean mode=0;
-	String line="";
-	for (uint16_t i=0; i < len; i++) {
+	if (!to2) {
+		return false;
+	}
+	uint8_t mode=0;
+	for (size_t i=0; i < len; i++) {
 		if (to2[i] == '"') { /* Quoted string */
 			mode ^= 1;
     } else if (((mode & 1) == 0) && (to2[i] == '<')) { /* Start of <>*/
@@ -383,25 +632,27 @@ void SMTPClient::addRecipients(const char * to) {
 			to2[i]='\n';
 		}
 	}
-	_Recipients += to2;
+	bool added = _Recipients.concat(to2);
+  trackMemory();
   free(to2);
+  return added;
 }
 
 /**
  * adds recepients to the list
  * @param to String - recepient
+ * @return false if there is not enough RAM
  */
-void SMTPClient::addRecipient(const char * to) {
-  String headerLine = to;
-  headerLine += "\n";
-  _Recipients += headerLine;
+bool SMTPClient::addRecipient(const char * to) {
+  return _Recipients.reserve(_Recipients.length() + strlen(to) + 1) && _Recipients.concat(to) && _Recipients.concat('\n');
 }
 /**
  * adds recepients to the list
  * @param to String - recepient
+ * @return false if there is not enough RAM
  */
-void SMTPClient::addRecipient(const String& to) {
-  addRecipient(to.c_str());
+bool SMTPClient::addRecipient(const String& to) {
+  return addRecipient(to.c_str());
 }
 
 /**
@@ -410,7 +661,7 @@ void SMTPClient::addRecipient(const String& to) {
  */
 void SMTPClient::disconnect() {
     if (connected()) {_returnCode = sendRequest("QUIT");}
-    _tcp->stop();
+    if (_tcp) {_tcp->stop();}
 }
 
 /**
@@ -434,34 +685,48 @@ bool SMTPClient::connect(void) {
             _tcps = NULL;
             _tcp = NULL;
         }
-        _tcps = new WiFiClientSecure();
+        /* Smaller buffers only work if the server limits its records to them */
+        if(_tlsReduced && !WiFiClientSecure::probeMaxFragmentLength(_host.c_str(), _port, SMTPCLIENT_TLS_REDUCED_BUFFER)) {
+            DEBUG_SMTPCLIENT("[SMTP-Client] server doesn't support %u byte TLS fragments\n", SMTPCLIENT_TLS_REDUCED_BUFFER);
+            return false;
+        }
+        _tcps = new (std::nothrow) WiFiClientSecure();
         _tcp = _tcps;
+        if(_tcps && _tlsReduced) {
+            _tcps->setBufferSizes(SMTPCLIENT_TLS_REDUCED_BUFFER, SMTPCLIENT_TLS_XMIT_BUFFER);
+        }
     } else {
         DEBUG_SMTPCLIENT("[SMTP-Client] connect smtp...\n");
         if(_tcp) {
             delete _tcp;
             _tcp = NULL;
         }
-        _tcp = new WiFiClient();
+        _tcp = new (std::nothrow) WiFiClient();
     }
 
-    if(!_tcp->connect(_host.c_str(), _port)) {
-        DEBUG_SMTPCLIENT("[SMTP-Client] failed connect to %s:%u\n", _host.c_str(), _port);
+    if(!_tcp) {
+        DEBUG_SMTPCLIENT("[SMTP-Client] not enough RAM for the connection\n");
         return false;
     }
 
-    DEBUG_SMTPCLIENT("[SMTP-Client] connected to %s:%u\n", _host.c_str(), _port);
-
-    if(_smtps && _smtpsFingerprint.length() > 0) {
-        if(_tcps->verify(_smtpsFingerprint.c_str(), _host.c_str())) {
-            DEBUG_SMTPCLIENT("[SMTP-Client] smtps certificate matches\n");
+    if(_smtps) { /* BearSSL checks the certificate during the handshake */
+        if(_smtpsFingerprint.length() > 0) {
+            if(!_tcps->setFingerprint(_smtpsFingerprint.c_str())) {
+                DEBUG_SMTPCLIENT("[SMTP-Client] invalid smtps fingerprint!\n");
+                return false;
+            }
         } else {
-            DEBUG_SMTPCLIENT("[SMTP-Client] smtps certificate doesn't match!\n");
-            _tcp->stop();
-            return false;
+            _tcps->setInsecure();
         }
     }
 
+    if(!_tcp->connect(_host.c_str(), _port)) {
+        DEBUG_SMTPCLIENT("[SMTP-Client] failed connect to %s:%u (or smtps certificate doesn't match)\n", _host.c_str(), _port);
+        return false;
+    }
+
+    DEBUG_SMTPCLIENT("[SMTP-Client] connected to %s:%u\n", _host.c_str(), _port);
+
     // set Timeout for readBytesUntil and readStringUntil
     _tcp->setTimeout(_tcpTimeout);
 
@@ -499,9 +764,169 @@ bool SMTPClient::sendHeaders() {
         return false;
     }
 
-    _Headers += nl;
+    if(_tcp->write(_Headers.c_str(), _Headers.length()) != _Headers.length()) {
+        return false;
+    }
+    return (_tcp->write(nl, 2) == 2);
+}
 
-    return (_tcp->write(_Headers.c_str(), _Headers.length()) == _Headers.length());
+/**
+ * relaxed header canonicalization (RFC 6376, 3.4.2)
+ * @param out String            canonicalized header field, without CRLF
+ * @param field const char *    raw header field, may be folded
+ * @param len size_t            length of the raw header field
+ */
+static void dkimRelaxedHeader(String & out, const char * field, size_t len) {
+    size_t i = 0;
+    out = "";
+    out.reserve(len);
+    while (i < len && field[i] != ':') {
+      out += (char) tolower(field[i++]);
+    }
+    out.trim();
+    out += ':';
+    bool value = false, wsp = false;
+    for (i++; i < len; i++) {
+      char c = field[i];
+      if (c == '\r' || c == '\n') { /* Unfold */
+        continue;
+      } else if (c == ' ' || c == '\t') { /* Runs of WSP become single SP, leading and trailing WSP is dropped */
+        wsp = true;
+        continue;
+      }
+      if (wsp && value) { out += ' '; }
+      out += c;
+      value = true;
+      wsp = false;
+    }
+}
+
+/**
+ * prepends DKIM-Signature header covering all the headers added so far
+ * The body is hashed straight from the payload buffer, so no copy of the message is made.
+ * @param payload const char *  message body
+ * @param size size_t           size of the message body
+ * @return 0 if the message was signed, SMTPC_ERROR_TOO_LESS_RAM or SMTPC_ERROR_DKIM_FAILED
+ */
+int SMTPClient::signDKIM(const char * payload, size_t size) {
+    uint8_t hash[br_sha256_SIZE];
+    br_sha256_context ctx;
+
+    // body hash, simple canonicalization of the body as sendPayload() sends it:
+    // bare LF becomes CRLF, trailing empty lines are ignored, body ends with CRLF
+    while (payload && size > 0 && payload[size - 1] == '\n') {
+      size--;
+      if (size > 0 && payload[size - 1] == '\r') { size--; }
+    }
+    br_sha256_init(&ctx);
+    if (payload && size > 0) {
+      const char * end = payload + size;
+      const char * start = payload;
+      for (const char * ptr = payload; (ptr = (const char *) memchr(ptr, '\n', end - ptr)) != NULL; ptr++) {
+        if (ptr == payload || ptr[-1] != '\r') {
+          br_sha256_update(&ctx, start, ptr - start);
+          br_sha256_update(&ctx, nl, 2);
+          start = ptr + 1;
+        }
+      }
+      br_sha256_update(&ctx, start, end - start);
+    }
+    br_sha256_update(&ctx, nl, 2);
+    br_sha256_out(&ctx, hash);
+    String bh = base64::encode(hash, sizeof(hash), false);
+
+    // header hash, fields are taken bottom-up so repeated names match the verifier's order
+    String h, canon;
+    const char * hdr = _Headers.c_str();
+    size_t end = _Headers.length();
+    br_sha256_init(&ctx);
+    while (end > 0) {
+      size_t start = end;
+      do { /* Find the first line of the field, skipping continuation lines */
+        start--;
+        while (start > 0 && hdr[start - 1] != '\n') { start--; }
+      } while (start > 0 && (hdr[start] == ' ' || hdr[start] == '\t'));
+      dkimRelaxedHeader(canon, &hdr[start], end - start);
+      if (h.length()) { h += ':'; }
+      h += canon.substring(0, canon.indexOf(':'));
+      br_sha256_update(&ctx, canon.c_str(), canon.length());
+      br_sha256_update(&ctx, nl, 2);
+      end = start;
+    }
+
+    String dkim = "v=1; a=rsa-sha256; c=relaxed/simple; d=" + _dkimDomain + "; s=" + _dkimSelector + "; h=" + h + "; bh=" + bh + "; b=";
+    String field = "DKIM-Signature: " + dkim;
+    dkimRelaxedHeader(canon, field.c_str(), field.length());
+    br_sha256_update(&ctx, canon.c_str(), canon.length());
+    br_sha256_out(&ctx, hash);
+
+    /* The core doesn't check the BearSSL stack allocation */
+    if (thunkBlock() > ESP.getMaxFreeBlockSize()) {
+      DEBUG_SMTPCLIENT("[SMTP-Client][signDKIM] no %u byte block for the BearSSL stack\n", thunkBlock());
+      return SMTPC_ERROR_TOO_LESS_RAM;
+    }
+    const br_rsa_private_key * sk = _dkimKey->getRSA();
+    size_t siglen = (sk->n_bitlen + 7) >> 3;
+    uint8_t * sig = (uint8_t *) malloc(siglen);
+    if (!sig) {
+      return SMTPC_ERROR_TOO_LESS_RAM;
+    }
+    yield(); /* Give the watchdog the full period for the private key operation */
+#ifdef ESP8266
+    stack_thunk_add_ref();
+#endif
+    trackMemory();
+    bool signedOk = dkim_rsa_pkcs1_sign(BR_HASH_OID_SHA256, hash, sizeof(hash), sk, sig);
+#ifdef ESP8266
+    stack_thunk_del_ref();
+#endif
+    if (!signedOk) {
+      DEBUG_SMTPCLIENT("[SMTP-Client][signDKIM] RSA signing failed\n");
+      free(sig);
+      return SMTPC_ERROR_DKIM_FAILED;
+    }
+    {
+      String b = base64::encode(sig, siglen, false);
+      free(sig);
+      if (!b.length() || !dkim.concat(b)) {
+        return SMTPC_ERROR_TOO_LESS_RAM;
+      }
+    }
+    bool added = addHeader("DKIM-Signature", dkim, true);
+    trackMemory();
+    return added ? 0 : SMTPC_ERROR_TOO_LESS_RAM;
+}
+
+/**
+ * sends the message body, bare LF line ends are sent as CRLF and
+ * the dot at the start of each line is doubled (RFC 5321, 2.3.8 and 4.5.2)
+ * Only the first size bytes are used, the payload does not need to be NUL terminated.
+ * @param payload const char *
+ * @param size size_t
+ * @return true if the whole body was written
+ */
+bool SMTPClient::sendPayload(const char * payload, size_t size) {
+    const char * end = payload + size;
+    const char * start = payload;
+    const char * ptr = payload;
+
+    if (size > 0 && payload[0] == '.' && _tcp->write(".", 1) != 1) {
+      return false;
+    }
+    while ((ptr = (const char *) memchr(ptr, '\n', end - ptr)) != NULL) {
+      bool bare = (ptr == payload || ptr[-1] != '\r');
+      bool dot = (ptr + 1 < end && ptr[1] == '.');
+      size_t len = ptr++ - start;
+      if (!bare && !dot) { continue; }
+      const char * eol = bare ? "\r\n." : "\n.";
+      size_t elen = (bare ? 2 : 1) + (dot ? 1 : 0);
+      if (_tcp->write(start, len) != len || _tcp->write(eol, elen) != elen) {
+        return false;
+      }
+      start = ptr;
+    }
+    size_t len = end - start;
+    return (_tcp->write(start, len) == len);
 }
 
 int SMTPClient::sendRequest(String &request) {
@@ -521,6 +946,19 @@ int SMTPClient::sendRequest(const char * request) {
 		return returnError(handleResponse());
 }
 
+/**
+ * reply code at the start of a reply line
+ * @param line const String &  one line of the reply
+ * @return 100..599, -1 if the line doesn't start with a reply code
+ */
+static int replyCode(const String & line) {
+    if(line.length() < 3 || line[0] < '1' || line[0] > '5'
+            || !isdigit((unsigned char) line[1]) || !isdigit((unsigned char) line[2])) {
+        return -1;
+    }
+    return (line[0] - '0') * 100 + (line[1] - '0') * 10 + (line[2] - '0');
+}
+
 /**
  * reads the response from the server
  * @return int smtp code
@@ -538,26 +976,45 @@ int SMTPClient::handleResponse() {
         size_t len = _tcp->available();
         if(len > 0) {
             String headerLine = _tcp->readStringUntil('\n');
-            headerLine.trim(); // remove \r
-
             lastDataTime = millis();
 
             DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] RX: '%s'\n", headerLine.c_str());
-      			_returnCode = headerLine.substring(0, 3).toInt();
-            _ErrorMessage = headerLine.substring(3);
-            while(headerLine[3] == '-') { 
-      				headerLine = _tcp->readStringUntil('\n'); 
-              _ErrorMessage += '\n' + headerLine.substring(3);
-      				DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] RX_line: '%s'\n", headerLine.c_str());
-      			}
-      			DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] code: %d\n", _returnCode);
-      
-      			if(_returnCode) {
-      				return _returnCode;
-      			} else {
-      				DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] Error - invalid response from SMTP Server!");
-      				return SMTPC_ERROR_NO_SMTP_SERVER;
-      			}
+            _returnCode = replyCode(headerLine);
+            _ErrorMessage = "";
+
+            /* "xyz-text" lines continue the reply, "xyz text" or "xyz" ends it */
+            for(bool more = false; ; more = true) {
+                if(_returnCode < 0 || replyCode(headerLine) != _returnCode) {
+                    DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] Error - invalid response from SMTP Server!\n");
+                    _returnCode = -1;
+                    return SMTPC_ERROR_NO_SMTP_SERVER;
+                }
+                if(headerLine[headerLine.length() - 1] == '\r') {
+                    headerLine.remove(headerLine.length() - 1);
+                }
+                if(_ErrorMessage.length() < SMTPCLIENT_MAX_REPLY_LENGTH) { /* Keep the start of a long reply */
+                    if(more) {
+                        _ErrorMessage += '\n';
+                    }
+                    size_t end = 4 + SMTPCLIENT_MAX_REPLY_LENGTH - _ErrorMessage.length();
+                    if(end > headerLine.length()) {
+                        end = headerLine.length();
+                    }
+                    if(end > 4) {
+                        _ErrorMessage += headerLine.substring(4, end);
+                    }
+                }
+                if(headerLine.length() < 4 || headerLine[3] != '-') {
+                    break;
+                }
+                headerLine = _tcp->readStringUntil('\n');
+                DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] RX_line: '%s'\n", headerLine.c_str());
+                if(headerLine.length() == 0) {
+                    return connected() ? SMTPC_ERROR_READ_TIMEOUT : SMTPC_ERROR_CONNECTION_LOST;
+                }
+            }
+            DEBUG_SMTPCLIENT("[SMTP-Client][handleResponse] code: %d\n", _returnCode);
+            return _returnCode;
         } else {
             if((millis() - lastDataTime) > _tcpTimeout) {
                 return SMTPC_ERROR_READ_TIMEOUT;
@@ -30,6 +30,10 @@
 #ifndef ESP8266SMTPClient_H_
 #define ESP8266SMTPClient_H_
 
+namespace BearSSL {
+    class PrivateKey;
+};
+
 //#define DEBUG_ESP_SMTP_CLIENT
 
 #ifdef DEBUG_ESP_SMTP_CLIENT
@@ -43,6 +47,40 @@
 #endif
 
 #define SMTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+/* Longest reply text kept for getErrorMessage(), lines are joined with '\n' */
+#define SMTPCLIENT_MAX_REPLY_LENGTH     (512)
+
+/* Subject bytes per RFC 2047 encoded word: 60 base64 characters, 72 with =?UTF-8?B?...?=,
+ * the first word is shorter to keep "Subject: " and it within 76 characters */
+#define SMTPCLIENT_SUBJECT_WORD_BYTES   (45)
+#define SMTPCLIENT_SUBJECT_FIRST_BYTES  (39)
+
+/* Heap taken by a new connection, used by the memory budget preflight */
+#ifndef SMTPCLIENT_TCP_RAM_ESTIMATE
+#define SMTPCLIENT_TCP_RAM_ESTIMATE     (2048)
+#endif
+#ifndef SMTPCLIENT_TLS_RAM_ESTIMATE
+#define SMTPCLIENT_TLS_RAM_ESTIMATE     (24576)
+#endif
+/* Largest single allocation of a new connection, checked against the largest free heap block */
+#ifndef SMTPCLIENT_TCP_BLOCK_ESTIMATE
+#define SMTPCLIENT_TCP_BLOCK_ESTIMATE   (512)
+#endif
+#ifndef SMTPCLIENT_TLS_BLOCK_ESTIMATE
+#define SMTPCLIENT_TLS_BLOCK_ESTIMATE   (16709)
+#endif
+/* Receive buffer of a TLS connection when the full one doesn't fit, the server has to accept
+ * it as max fragment length (512, 1024, 2048 or 4096) */
+#ifndef SMTPCLIENT_TLS_REDUCED_BUFFER
+#define SMTPCLIENT_TLS_REDUCED_BUFFER   (4096)
+#endif
+#define SMTPCLIENT_TLS_XMIT_BUFFER              (512)
+#define SMTPCLIENT_TLS_REDUCED_BLOCK_ESTIMATE   (SMTPCLIENT_TLS_REDUCED_BUFFER + 325)
+#define SMTPCLIENT_TLS_REDUCED_RAM_ESTIMATE     (SMTPCLIENT_TLS_RAM_ESTIMATE - SMTPCLIENT_TLS_BLOCK_ESTIMATE + SMTPCLIENT_TLS_REDUCED_BLOCK_ESTIMATE)
+/* BearSSL stack used for the DKIM signature, shared with a BearSSL connection (5600 bytes on core 2.5.0) */
+#ifndef SMTPCLIENT_THUNK_RAM_ESTIMATE
+#define SMTPCLIENT_THUNK_RAM_ESTIMATE   (6200)
+#endif
 
 #define SMTPC_ERROR_CONNECTION_REFUSED  (-1)
 #define SMTPC_ERROR_SEND_HEADER_FAILED  (-2)
@@ -58,6 +96,7 @@
 #define SMTPC_ERROR_INVALID_SENDER      (-13)
 #define SMTPC_ERROR_INVALID_RECIPIENT   (-14)
 #define SMTPC_ERROR_INVALID_ENVELOPE    (-15)
+#define SMTPC_ERROR_DKIM_FAILED         (-16)
 
 class SMTPClient {
     public:
@@ -73,13 +112,18 @@ class SMTPClient {
         void setAuthorization(const char * user, const char * password);
         void setTimeout(uint16_t timeout);
         void setMailer(const char * mailer);
+        bool setDKIM(const char * domain, const char * selector, const char * privateKey);
+        void clearDKIM(void);
+        void setMemoryBudget(size_t budget);
+        size_t estimateMemory(const char * from, const char * to = NULL, const char * subject = NULL);
+        size_t getMemoryHighWater() { return _memHighWater; }
 
         int sendMessage(const char * from, const char * payload, size_t size, const char* to=NULL, const char * subject = NULL);
         int sendMessage(const char * from, String & payload, const char* to=NULL, const char * subject = NULL);
 
-        void addHeader(const String& name, const String& value, bool first = false);
-        void addRecipient(const String& to);
-        void addRecipient(const char* to);
+        bool addHeader(const String& name, const String& value, bool first = false);
+        bool addRecipient(const String& to);
+        bool addRecipient(const char* to);
         inline void clearHeaders() { _Headers = ""; }
         inline void clearRecipients() { _Recipients = ""; }
         void disconnect();
@@ -115,19 +159,35 @@ class SMTPClient {
         String _base64User;
         String _base64Pass;
 
+        String _dkimDomain;
+        String _dkimSelector;
+        BearSSL::PrivateKey * _dkimKey;
+
+        size_t _memBudget;
+        uint32_t _memBase;
+        size_t _memHighWater;
+        bool _tlsReduced;
+
         /// Response handling
         int _returnCode;
 
         int returnError(int error);
         bool connect(void);
         bool sendHeaders();
+        bool sendPayload(const char * payload, size_t size);
+        int signDKIM(const char * payload, size_t size);
         int sendRequest(const char * request);
         int sendRequest(String &request);
         int sendAddress(String &cmd, String &address);
         int sendAddress(const char *cmd, const char * address);
         int handleResponse();
-        void addRecipients(const char* to);
-        void addRecipients(String& to);
+        bool addRecipients(const char* to);
+        bool addRecipients(String& to);
+        size_t headersLength(const char * from, const char * to, const char * subject);
+        size_t largestBlock(void);
+        bool fitsMemory(const char * from, const char * to, const char * subject);
+        static bool encodeSubject(String & out, const char * subject);
+        void trackMemory(void);
 };
 
 